@@ -0,0 +1,339 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <map>
+#include <chrono>
+#include "common.hpp"
+#include "player.hpp"
+#include "board.hpp"
+
+// Use this file to measure the engine on a fixed set of positions. Results go
+// to a tab-separated file (bench_output.txt by default) which is compared
+// against a stored baseline (bench_baseline.txt) to give a verdict.
+
+struct BenchPosition {
+    const char *name;
+    // Row by row from the top: 'b', 'w' or '-' for empty.
+    const char *board;
+    Side side;
+    // Midgame positions are searched to each depth from 1 to this one.
+    // 0 means solve the position exactly instead.
+    int depth;
+    // Exact final disc difference for the side to move (solved positions).
+    int score;
+    // Best move(s) as "x y", separated by '|'; empty if not known.
+    const char *best;
+};
+
+// Endgame scores and best moves were worked out with a separate exhaustive
+// solver, using the same scoring as Player::calcScore (empties not counted).
+static const BenchPosition SUITE[] = {
+    {"testminimax",
+        "----------------"
+        "-b------bwbbbb--"
+        "----------------"
+        "----------------",
+        WHITE, 2, 0, ""},
+    {"mid40",
+        "---w-b----wwwww-"
+        "-b-wbw--wbbbw---"
+        "-wbww---bbww----"
+        "----------------",
+        BLACK, 5, 0, ""},
+    {"mid34",
+        "-b--------bw----"
+        "-wwwwbb---wwbw-b"
+        "--bwbbw---wbwbbw"
+        "-wb--bb------b--",
+        BLACK, 4, 0, ""},
+    {"mid28",
+        "---b----b--b-bw-"
+        "-b-bbb---bbwwbww"
+        "wbwwbwb-b-bww-w-"
+        "-bbwbb----ww-w--",
+        BLACK, 5, 0, ""},
+    {"end8",
+        "wwbbww-bbwbbwwbw"
+        "-bwbwbb-bbbwbw-b"
+        "bbwwwwwwbwww-www"
+        "w-wwwwbw--wwwwww",
+        BLACK, 0, 2, "0 7"},
+    {"end9",
+        "--wwww-w---wwwwb"
+        "bbbwwwbbwbbwbbwb"
+        "-wbbbbwb-bbbwwbb"
+        "bbbwbbbb-wwwwwww",
+        WHITE, 0, 10, "0 7"},
+    {"end10",
+        "-bbbbwwbwwwwwwwb"
+        "bwbbwwwbbbbwwwbb"
+        "bbbwwbbbb-wwbbwb"
+        "-wwbb--b-wb-b---",
+        BLACK, 0, 10, "0 0"},
+    {"end11",
+        "w---b--b-wbbbbbb"
+        "--bbbbbbbbwwbwbb"
+        "bwbwwwbbwwwwwwbb"
+        "w-wwwwwbw-wwww-w",
+        WHITE, 0, 2, "1 0"},
+};
+
+// Searches are repeated this many times and the fastest is reported.
+#define REPEATS 3
+
+// Times below this many ms are too noisy to call faster or slower.
+#define MIN_COMPARE_MS 5.0
+
+// A change in time of more than this fraction is reported for a single search.
+// Single searches are noisy, so the verdict uses the total time, which must
+// change by more than TOTAL_TOLERANCE. Node counts are exact.
+#define TIME_TOLERANCE 0.25
+#define TOTAL_TOLERANCE 0.10
+
+/*
+ * One line of results: a search of one position to one depth (or solved).
+ */
+struct BenchResult {
+    string name;
+    string kind;
+    int depth;
+    double ms;
+    unsigned long nodes;
+    double nps;
+    string move;
+    int score;
+    string correct;
+};
+
+static string formatMove(Move *move) {
+    if (move == nullptr) return "pass";
+    return to_string(move->x) + " " + to_string(move->y);
+}
+
+/*
+ * Runs one search on a fresh player, so no results are reused between runs.
+ */
+static BenchResult runSearch(const BenchPosition &position, int depth,
+    bool solve) {
+    char data[8][8];
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) {
+            data[y][x] = position.board[8 * y + x];
+        }
+    }
+
+    BenchResult result;
+    result.name = position.name;
+    result.kind = solve ? "solve" : "depth";
+    result.depth = depth;
+    result.ms = -1;
+
+    for (int i = 0; i < REPEATS; i++) {
+        Player *player = new Player(position.side, nullptr);
+        player->board->setBoard(data);
+        if (solve) {
+            depth = player->board->countEmpty();
+            result.depth = depth;
+        }
+
+        int score;
+        auto start = chrono::steady_clock::now();
+        Move *move = player->search(depth, !solve, &score);
+        auto end = chrono::steady_clock::now();
+        double ms = chrono::duration<double, milli>(end - start).count();
+
+        if (result.ms < 0 || ms < result.ms) result.ms = ms;
+        result.nodes = player->nodes;
+        result.move = formatMove(move);
+        result.score = score;
+
+        delete move;
+        delete player;
+    }
+    result.nps = (result.ms > 0) ? result.nodes * 1000.0 / result.ms : 0;
+
+    // Check the answer where it is known.
+    string best = position.best;
+    if (best.empty()) {
+        result.correct = "-";
+    }
+    else {
+        bool found = ("|" + best + "|").find("|" + result.move + "|")
+            != string::npos;
+        bool scored = !solve || result.score == position.score;
+        result.correct = (found && scored) ? "yes" : "no";
+    }
+    return result;
+}
+
+static string resultKey(const BenchResult &result) {
+    return result.name + "/" + result.kind + "/" + to_string(result.depth);
+}
+
+/*
+ * Reads a results file written by writeResults. Returns false if it can't.
+ */
+static bool readResults(const char *path, map<string, BenchResult> &results) {
+    ifstream in(path);
+    if (!in) return false;
+
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        stringstream fields(line);
+        BenchResult result;
+        string depth, ms, nodes, nps, score;
+        getline(fields, result.name, '\t');
+        getline(fields, result.kind, '\t');
+        getline(fields, depth, '\t');
+        getline(fields, ms, '\t');
+        getline(fields, nodes, '\t');
+        getline(fields, nps, '\t');
+        getline(fields, result.move, '\t');
+        getline(fields, score, '\t');
+        getline(fields, result.correct, '\t');
+        result.depth = atoi(depth.c_str());
+        result.ms = atof(ms.c_str());
+        result.nodes = strtoul(nodes.c_str(), nullptr, 10);
+        result.nps = atof(nps.c_str());
+        result.score = atoi(score.c_str());
+        results[resultKey(result)] = result;
+    }
+    return true;
+}
+
+static void writeResults(const char *path, vector<BenchResult> &results) {
+    ofstream out(path);
+    out << "# name\tkind\tdepth\tms\tnodes\tnps\tmove\tscore\tcorrect" << endl;
+    for (unsigned int i = 0; i < results.size(); i++) {
+        BenchResult &r = results[i];
+        out << r.name << "\t" << r.kind << "\t" << r.depth << "\t"
+            << fixed << setprecision(3) << r.ms << "\t" << r.nodes << "\t"
+            << setprecision(0) << r.nps << "\t" << r.move << "\t" << r.score
+            << "\t" << r.correct << endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 3) {
+        cerr << "usage: " << argv[0] << " [output [baseline]]" << endl;
+        exit(-1);
+    }
+    const char *outputPath = (argc > 1) ? argv[1] : "bench_output.txt";
+    const char *baselinePath = (argc > 2) ? argv[2] : nullptr;
+
+    // Run the suite.
+    vector<BenchResult> results;
+    int wrong = 0;
+    cout << "position     kind  depth          ms       nodes         nps"
+        "  move   score  correct" << endl;
+    for (const BenchPosition &position : SUITE) {
+        int first = (position.depth == 0) ? 0 : 1;
+        for (int depth = first; depth <= position.depth; depth++) {
+            BenchResult r = runSearch(position, depth, position.depth == 0);
+            results.push_back(r);
+            if (r.correct == "no") wrong++;
+
+            cout << left << setw(12) << r.name << " " << setw(5) << r.kind
+                << right << setw(7) << r.depth << fixed << setprecision(2)
+                << setw(12) << r.ms << setw(12) << r.nodes << setprecision(0)
+                << setw(12) << r.nps << "  " << left << setw(5) << r.move
+                << right << setw(7) << r.score << "  " << r.correct << endl;
+        }
+    }
+    writeResults(outputPath, results);
+    cout << "Results written to " << outputPath << endl;
+
+    if (baselinePath == nullptr) return wrong == 0 ? 0 : 1;
+
+    // Compare against the baseline.
+    map<string, BenchResult> baseline;
+    if (!readResults(baselinePath, baseline)) {
+        cerr << "could not read baseline " << baselinePath << endl;
+        return 1;
+    }
+
+    int broken = 0, fixedCount = 0, changed = 0;
+    double totalMs = 0, baselineMs = 0;
+    unsigned long totalNodes = 0, baselineNodes = 0;
+    cout << endl << "Compared with " << baselinePath << ":" << endl;
+    for (unsigned int i = 0; i < results.size(); i++) {
+        BenchResult &r = results[i];
+        auto it = baseline.find(resultKey(r));
+        if (it == baseline.end()) {
+            cout << "  " << resultKey(r) << ": new" << endl;
+            continue;
+        }
+        BenchResult &b = it->second;
+        totalMs += r.ms;
+        baselineMs += b.ms;
+        totalNodes += r.nodes;
+        baselineNodes += b.nodes;
+
+        vector<string> notes;
+        if (b.correct == "yes" && r.correct == "no") {
+            notes.push_back("now WRONG");
+            broken++;
+        }
+        else if (b.correct == "no" && r.correct == "yes") {
+            notes.push_back("now correct");
+            fixedCount++;
+        }
+        if (r.move != b.move || r.score != b.score) {
+            notes.push_back("result " + b.move + " (" + to_string(b.score)
+                + ") -> " + r.move + " (" + to_string(r.score) + ")");
+            changed++;
+        }
+        if (r.nodes != b.nodes) {
+            notes.push_back("nodes " + to_string(b.nodes) + " -> "
+                + to_string(r.nodes));
+        }
+        if (r.ms >= MIN_COMPARE_MS || b.ms >= MIN_COMPARE_MS) {
+            double ratio = r.ms / b.ms;
+            stringstream time;
+            time << fixed << setprecision(2) << "time x" << ratio;
+            if (ratio > 1 + TIME_TOLERANCE) {
+                notes.push_back(time.str() + " slower");
+            }
+            else if (ratio < 1 - TIME_TOLERANCE) {
+                notes.push_back(time.str() + " faster");
+            }
+        }
+
+        if (!notes.empty()) {
+            cout << "  " << resultKey(r) << ":";
+            for (unsigned int j = 0; j < notes.size(); j++) {
+                cout << (j == 0 ? " " : ", ") << notes[j];
+            }
+            cout << endl;
+        }
+    }
+
+    double ratio = (baselineMs > 0) ? totalMs / baselineMs : 1;
+    bool slower = ratio > 1 + TOTAL_TOLERANCE;
+    bool faster = ratio < 1 - TOTAL_TOLERANCE;
+    cout << fixed << setprecision(2) << "Total time " << totalMs << " ms vs "
+        << baselineMs << " ms (x" << ratio << "), nodes " << totalNodes
+        << " vs " << baselineNodes << endl;
+    cout << "Verdict: ";
+    if (broken > 0 || slower || totalNodes > baselineNodes) {
+        cout << "REGRESSION (" << broken << " wrong"
+            << (slower ? ", slower" : "")
+            << (totalNodes > baselineNodes ? ", more nodes" : "") << ")";
+    }
+    else if (fixedCount > 0 || faster || totalNodes < baselineNodes) {
+        cout << "IMPROVEMENT (" << fixedCount << " fixed"
+            << (faster ? ", faster" : "")
+            << (totalNodes < baselineNodes ? ", fewer nodes" : "") << ")";
+    }
+    else {
+        cout << "NEUTRAL";
+    }
+    if (changed > 0) cout << ", " << changed << " results changed";
+    cout << endl;
+
+    return wrong == 0 ? 0 : 1;
+}
@@ -1,6 +1,10 @@
 #include "board.hpp"
+#include "flips.hpp"
 #include <iostream>
 
+// Bitboard of column 0 (bit 8 * y for every row y).
+#define COLUMN_0 0x0101010101010101ULL
+
 /*
  * Make a standard 8x8 othello board and initialize it to the standard setup.
  */
@@ -10,6 +14,14 @@ Board::Board() {
     counts[EMPTY] = 64;
     counts[WHITE] = 0;
     counts[BLACK] = 0;
+    discs[EMPTY] = ~0ULL;
+    discs[WHITE] = 0;
+    discs[BLACK] = 0;
+    frontier = 0;
+    for (int i = 0; i < 3; i++) {
+        moves[i] = 0;
+        movesKnown[i] = false;
+    }
 
     // Set whites at (3,3) and (4,4)
     set(WHITE, 3, 3);
@@ -33,6 +45,10 @@ Board *Board::copy() {
     Board *newBoard = new Board();
     std::copy(&board[0][0], &board[0][0] + 8 * 8, &newBoard->board[0][0]);
     std::copy(begin(counts), end(counts), begin(newBoard->counts));
+    std::copy(begin(discs), end(discs), begin(newBoard->discs));
+    newBoard->frontier = frontier;
+    std::copy(begin(moves), end(moves), begin(newBoard->moves));
+    std::copy(begin(movesKnown), end(movesKnown), begin(newBoard->movesKnown));
     return newBoard;
 }
 
@@ -47,21 +63,35 @@ int Board::get(int x, int y) {
 void Board::set(Side side, int x, int y) {
     Side other = (side == BLACK) ? WHITE : BLACK;
 
-    // First, update the counts.
+    uint64_t bit = 1ULL << (8 * y + x);
+
+    // First, update the counts and bitboards.
     counts[side]++;
+    discs[side] |= bit;
 
     if (get(x, y) == other)
     {
         counts[other]--;
+        discs[other] &= ~bit;
     }
     else
     {
         counts[EMPTY]--;
+        discs[EMPTY] &= ~bit;
+
+        // A newly filled square leaves the frontier and brings its empty
+        // neighbours onto it.
+        frontier &= ~bit;
+        frontier |= NEIGHBOURS.masks[8 * y + x] & discs[EMPTY];
     }
 
     // Then place the piece.
     board[y][x] = side;
 
+    // Any cached legal moves are now out of date.
+    movesKnown[WHITE] = false;
+    movesKnown[BLACK] = false;
+
 }
 
 bool Board::onBoard(int x, int y) {
@@ -81,13 +111,7 @@ bool Board::isDone() {
  * Returns true if there are legal moves for the given side.
  */
 bool Board::hasMoves(Side side) {
-    for (int i = 0; i < 8; i++) {
-        for (int j = 0; j < 8; j++) {
-            Move move(i, j);
-            if (checkMove(&move, side)) return true;
-        }
-    }
-    return false;
+    return legalMoves(side) != 0;
 }
 
 /*
@@ -97,31 +121,68 @@ bool Board::checkMove(Move *m, Side side) {
     // Passing is only legal if you have no moves.
     if (m == nullptr) return !hasMoves(side);
 
-    int X = m->getX();
-    int Y = m->getY();
+    return (legalMoves(side) >> (8 * m->getY() + m->getX())) & 1;
+}
+
+/*
+ * Returns the bitboard of squares the given side can legally play. This is
+ * computed at most once per position; set() clears the cached result.
+ */
+uint64_t Board::legalMoves(Side side) {
+    if (!movesKnown[side]) {
+        // Only frontier squares need checking.
+        moves[side] = 0;
+        uint64_t candidates = frontier;
+        while (candidates != 0) {
+            int square = __builtin_ctzll(candidates);
+            if (flips(square % 8, square / 8, side) != 0) {
+                moves[side] |= 1ULL << square;
+            }
+            candidates &= candidates - 1;
+        }
+        movesKnown[side] = true;
+    }
+    return moves[side];
+}
 
+/*
+ * Returns the bitboard of discs that side would flip by playing at (X, Y);
+ * zero means the move is illegal. Each row, column and diagonal through the
+ * square is packed into 8 bits and its flips come from LINE_FLIPS.
+ */
+uint64_t Board::flips(int X, int Y, Side side) {
     // Make sure the square hasn't already been taken.
-    if (occupied(X, Y)) return false;
+    if (occupied(X, Y)) return 0;
 
     Side other = (side == BLACK) ? WHITE : BLACK;
-    for (int dx = -1; dx <= 1; dx++) {
-        for (int dy = -1; dy <= 1; dy++) {
-            if (dy == 0 && dx == 0) continue;
-
-            // Is there a capture in that direction?
-            int x = X + dx;
-            int y = Y + dy;
-            if (onBoard(x, y) && (get(x, y) == other)) {
-                do {
-                    x += dx;
-                    y += dy;
-                } while (onBoard(x, y) && (get(x, y) == other));
+    uint64_t own = discs[side];
+    uint64_t opp = discs[other];
+    int square = 8 * Y + X;
+    uint64_t result = 0;
+
+    // Row: already a byte.
+    uint8_t line = lineFlips(X, own >> (8 * Y), opp >> (8 * Y));
+    result |= (uint64_t) line << (8 * Y);
+
+    // Column: gather bit 8 * y + X into bit y of the top byte.
+    line = lineFlips(Y,
+        (((own >> X) & COLUMN_0) * 0x0102040810204080ULL) >> 56,
+        (((opp >> X) & COLUMN_0) * 0x0102040810204080ULL) >> 56);
+    result |= COLUMNS.masks[line] << X;
+
+    // Diagonals: each square is in a different column, so summing all rows
+    // into the top byte leaves bit x for square (x, y).
+    uint64_t diagonal = DIAGONALS.masks[square];
+    line = lineFlips(X, ((own & diagonal) * COLUMN_0) >> 56,
+        ((opp & diagonal) * COLUMN_0) >> 56);
+    result |= (line * COLUMN_0) & diagonal;
+
+    uint64_t antiDiagonal = ANTI_DIAGONALS.masks[square];
+    line = lineFlips(X, ((own & antiDiagonal) * COLUMN_0) >> 56,
+        ((opp & antiDiagonal) * COLUMN_0) >> 56);
+    result |= (line * COLUMN_0) & antiDiagonal;
 
-                if (onBoard(x, y) && (get(x, y) == side)) return true;
-            }
-        }
-    }
-    return false;
+    return result;
 }
 
 /**
@@ -184,25 +245,13 @@ vector<Move*> Board::getMoves(Side side)
     // The results.
     vector<Move*> results;
 
-    // Loop through every position and call checkMove.
-    for (int y = 0; y < 8; y++)
+    // Walk the cached legal moves in square order (top row first).
+    uint64_t available = legalMoves(side);
+    while (available != 0)
     {
-        for (int x = 0; x < 8; x++)
-        {
-            // Make the new move.
-            Move *newMove = new Move(x, y);
-            // cerr << "checking move: " << newMove->getX() << " " << newMove->getY() <<endl;
-
-            // Check if the new move is valid for side.
-            if (checkMove(newMove, side))
-            {
-                results.push_back(newMove);
-            }
-            else
-            {
-                delete newMove;
-            }
-        }
+        int square = __builtin_ctzll(available);
+        results.push_back(new Move(square % 8, square / 8));
+        available &= available - 1;
     }
 
     return results;
@@ -216,6 +265,31 @@ void Board::doMove(Move *m, Side side) {
     // A nullptr move means pass.
     if (m == nullptr) return;
 
+    int X = m->getX();
+    int Y = m->getY();
+
+    uint64_t flipped = flips(X, Y, side);
+    if (flipped == 0) return;
+
+    // First, flip the captured discs.
+    while (flipped != 0) {
+        int square = __builtin_ctzll(flipped);
+        set(side, square % 8, square / 8);
+        flipped &= flipped - 1;
+    }
+
+    // Finally, make the move.
+    set(side, X, Y);
+}
+
+/*
+ * Same as doMove, but finds the captures one square at a time with
+ * checkMoveCapture. Kept to check the table-driven doMove against.
+ */
+void Board::doMoveReference(Move *m, Side side) {
+    // A nullptr move means pass.
+    if (m == nullptr) return;
+
     // Check the move is valid AND get moves required.
     Capture check = checkMoveCapture(m, side);
 
@@ -268,6 +342,39 @@ int Board::countEmpty() {
     return counts[EMPTY];
 }
 
+/*
+ * Bitboard of the squares holding the given Side value, where square (x, y)
+ * is bit 8 * y + x.
+ */
+uint64_t Board::getDiscs(Side side) {
+    return discs[side];
+}
+
+/*
+ * Bitboard of the frontier: empty squares next to at least one disc.
+ */
+uint64_t Board::getFrontier() {
+    return frontier;
+}
+
+/*
+ * Potential mobility of the given side: the number of frontier squares next
+ * to an opponent's disc, i.e. squares it may be able to play later.
+ */
+int Board::potentialMobility(Side side) {
+    uint64_t opp = discs[(side == BLACK) ? WHITE : BLACK];
+
+    // Every square touching an opponent's disc. Shifts that move a disc
+    // sideways are masked so it can't wrap onto the other edge.
+    uint64_t notLeftEdge = 0xFEFEFEFEFEFEFEFEULL;
+    uint64_t notRightEdge = 0x7F7F7F7F7F7F7F7FULL;
+    uint64_t touching = (opp << 8) | (opp >> 8)
+        | (((opp << 1) | (opp << 9) | (opp >> 7)) & notLeftEdge)
+        | (((opp >> 1) | (opp >> 9) | (opp << 7)) & notRightEdge);
+
+    return __builtin_popcountll(frontier & touching);
+}
+
 /*
  * Prints current board to terminal.
  */
@@ -293,6 +400,14 @@ void Board::setBoard(char data[8][8]) {
     counts[EMPTY] = 64;
     counts[WHITE] = 0;
     counts[BLACK] = 0;
+    discs[EMPTY] = ~0ULL;
+    discs[WHITE] = 0;
+    discs[BLACK] = 0;
+    frontier = 0;
+    for (int i = 0; i < 3; i++) {
+        moves[i] = 0;
+        movesKnown[i] = false;
+    }
 
     for (int y = 0; y < 8; y++) {
         for (int x = 0; x < 8; x++) {
@@ -2,6 +2,7 @@
 #define __BOARD_H__
 
 #include "common.hpp"
+#include <cstdint>
 #include <vector>
 using namespace std;
 
@@ -24,9 +25,24 @@ private:
     // # of black spaces = counts[BLACK]
     int counts[3];
 
+    // The squares held by each Side value as bitboards, where
+    // square (x, y) is bit 8 * y + x.
+    uint64_t discs[3];
+
+    // The frontier: empty squares next to at least one disc. Only these
+    // can ever be legal moves. Kept up to date by set().
+    uint64_t frontier;
+
+    // The legal moves for each side as bitboards. They are worked out the
+    // first time they are asked for and forgotten whenever a disc changes.
+    uint64_t moves[3];
+    bool movesKnown[3];
+
     bool occupied(int x, int y);
     void set(Side side, int x, int y);
     bool onBoard(int x, int y);
+    uint64_t flips(int X, int Y, Side side);
+    uint64_t legalMoves(Side side);
 
 public:
     Board();
@@ -39,11 +55,15 @@ public:
     bool checkMove(Move *m, Side side);
     Capture checkMoveCapture(Move *m, Side side);
     void doMove(Move *m, Side side);
+    void doMoveReference(Move *m, Side side);
     vector<Move*> getMoves(Side side);
     int count(Side side);
     int countBlack();
     int countWhite();
     int countEmpty();
+    uint64_t getDiscs(Side side);
+    uint64_t getFrontier();
+    int potentialMobility(Side side);
 
     void setBoard(char data[8][8]);
     void printBoard();
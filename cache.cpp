@@ -0,0 +1,348 @@
+#include "cache.hpp"
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CACHE_MAGIC "OTHCACHE"
+#define CACHE_VERSION 4
+
+/*
+ * The start of every cache file. The slots follow it back to back.
+ */
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entrySize;
+    uint64_t slots;
+    // Player::cacheFingerprint() of the build that made the file.
+    uint64_t fingerprint;
+};
+
+#define CACHE_FILE_SIZE (sizeof(CacheHeader) + CACHE_SLOTS * sizeof(CacheEntry))
+
+// Times to try opening the file when other processes are replacing it.
+#define CACHE_OPEN_ATTEMPTS 3
+
+/*
+ * Returns true if fd is a cache file this build can use.
+ */
+static bool usable(int fd, uint64_t fingerprint) {
+    struct stat st;
+    CacheHeader header;
+    return fstat(fd, &st) == 0
+        && (size_t) st.st_size == CACHE_FILE_SIZE
+        && pread(fd, &header, sizeof(header), 0) == sizeof(header)
+        && memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) == 0
+        && header.version == CACHE_VERSION
+        && header.entrySize == sizeof(CacheEntry)
+        && header.slots == CACHE_SLOTS
+        && header.fingerprint == fingerprint;
+}
+
+/*
+ * Returns true if fd is still the file at path.
+ */
+static bool atPath(const char *path, int fd) {
+    struct stat opened, named;
+    return fstat(fd, &opened) == 0 && stat(path, &named) == 0
+        && opened.st_dev == named.st_dev && opened.st_ino == named.st_ino;
+}
+
+/*
+ * Puts a new, empty cache file at path. It is built under another name and
+ * renamed into place, so processes still using the old file keep a valid
+ * mapping of it. Returns false if it can't.
+ */
+static bool replace(const char *path, uint64_t fingerprint) {
+    string fresh = string(path) + ".new." + to_string(getpid());
+    int out = open(fresh.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        perror(fresh.c_str());
+        return false;
+    }
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    header.version = CACHE_VERSION;
+    header.entrySize = sizeof(CacheEntry);
+    header.slots = CACHE_SLOTS;
+    header.fingerprint = fingerprint;
+    bool ok = pwrite(out, &header, sizeof(header), 0) == sizeof(header)
+        && ftruncate(out, CACHE_FILE_SIZE) == 0
+        && rename(fresh.c_str(), path) == 0;
+    if (!ok) {
+        perror(path);
+        unlink(fresh.c_str());
+    }
+    close(out);
+    return ok;
+}
+
+/*
+ * Opens (creating if necessary) the cache file at path and maps it. A file
+ * left by an incompatible build, one whose scores were made with a different
+ * fingerprint, or a damaged one, is replaced by an empty one. A nullptr path, or a file that cannot be set up, gives a cache that is
+ * always empty.
+ */
+PositionCache::PositionCache(const char *path, uint64_t fingerprint) {
+    fd = -1;
+    mapped = nullptr;
+    slots = nullptr;
+
+    if (path == nullptr) return;
+
+    for (int attempt = 0; attempt < CACHE_OPEN_ATTEMPTS; attempt++) {
+        fd = open(path, O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            perror(path);
+            return;
+        }
+
+        // Readers share the lock; only replacing the file needs it
+        // exclusively.
+        flock(fd, LOCK_SH);
+        if (usable(fd, fingerprint)) break;
+        flock(fd, LOCK_EX);
+        if (usable(fd, fingerprint)) break;
+
+        // Another process may have replaced it while we waited for the lock,
+        // in which case we just open the new one.
+        if (atPath(path, fd)) {
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size > 0) {
+                cerr << "replacing incompatible cache file " << path << endl;
+            }
+            if (!replace(path, fingerprint)) {
+                close(fd);
+                fd = -1;
+                return;
+            }
+        }
+        close(fd);
+        fd = -1;
+    }
+    if (fd < 0) {
+        cerr << "could not set up cache file " << path << endl;
+        return;
+    }
+
+    void *data = mmap(nullptr, CACHE_FILE_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+    flock(fd, LOCK_UN);
+    if (data == MAP_FAILED) {
+        perror(path);
+        close(fd);
+        fd = -1;
+        return;
+    }
+    mapped = (char *) data;
+    slots = (const CacheEntry *) (mapped + sizeof(CacheHeader));
+}
+
+/*
+ * Releases the file.
+ */
+PositionCache::~PositionCache() {
+    if (mapped != nullptr) munmap(mapped, CACHE_FILE_SIZE);
+    if (fd >= 0) close(fd);
+}
+
+/*
+ * Returns the cache file to use, from OTHELLO_CACHE if it is set.
+ */
+const char *PositionCache::defaultPath() {
+    const char *path = getenv("OTHELLO_CACHE");
+    return (path != nullptr && *path != '\0') ? path : DEFAULT_CACHE_PATH;
+}
+
+/*
+ * Hashes a position, the side to move and the side the score is for.
+ */
+uint64_t PositionCache::key(uint64_t black, uint64_t white, int toMove,
+    int perspective) {
+    uint64_t h = black * 0x9E3779B97F4A7C15ULL;
+    h ^= (white + 0xBF58476D1CE4E5B9ULL + (h << 6) + (h >> 2));
+    h ^= (uint64_t) (toMove * 4 + perspective) * 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return h;
+}
+
+/*
+ * Checksum of everything in an entry except the check field itself.
+ */
+uint64_t PositionCache::check(const CacheEntry *entry) {
+    uint64_t rest = ((uint64_t) (uint32_t) entry->score << 16)
+        | ((uint64_t) entry->depth << 8) | entry->heuristic;
+    uint64_t h = key(entry->black, entry->white, entry->toMove,
+        entry->perspective) ^ (rest * 0xD6E8FEB86659FD93ULL);
+    return h ^ (h >> 29);
+}
+
+/*
+ * Returns true if entry holds a result for this exact position that is at
+ * least as deep as the one asked for.
+ */
+bool PositionCache::matches(const CacheEntry *entry, Board *board,
+    Side toMove, Side perspective, int depth, bool heuristic) {
+    return entry->black == board->getDiscs(BLACK)
+        && entry->white == board->getDiscs(WHITE)
+        && entry->toMove == toMove
+        && entry->perspective == perspective
+        && entry->heuristic == heuristic
+        && entry->depth >= depth;
+}
+
+/*
+ * Looks up the score of board with toMove to play, searched to at least
+ * depth plies, in the file. Returns true and sets score if there is one.
+ * Safe to call from any thread.
+ */
+bool PositionCache::lookup(Board *board, Side toMove, Side perspective,
+    int depth, bool heuristic, int *score) {
+    if (slots == nullptr) return false;
+
+    uint64_t k = key(board->getDiscs(BLACK), board->getDiscs(WHITE), toMove,
+        perspective);
+
+    // Copy each slot out before checking it, since another process may be
+    // writing it.
+    for (int i = 0; i < CACHE_PROBES; i++) {
+        CacheEntry entry = slots[(k + i) & (CACHE_SLOTS - 1)];
+        if (entry.depth > 0 && entry.check == check(&entry)
+            && matches(&entry, board, toMove, perspective, depth, heuristic)) {
+            *score = entry.score;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Puts one entry into the file's table. Must hold the exclusive lock. The
+ * entry goes in the slot already holding its position, else an empty slot,
+ * else over the shallowest result in its probe range (if that is no deeper).
+ */
+void PositionCache::writeEntry(const CacheEntry &entry) {
+    uint64_t k = key(entry.black, entry.white, entry.toMove, entry.perspective);
+    int target = -1;
+    int targetDepth = 256;
+
+    for (int i = 0; i < CACHE_PROBES; i++) {
+        int slot = (k + i) & (CACHE_SLOTS - 1);
+        const CacheEntry &old = slots[slot];
+        bool valid = old.depth > 0 && old.check == check(&old);
+
+        if (valid && old.black == entry.black && old.white == entry.white
+            && old.toMove == entry.toMove && old.perspective == entry.perspective
+            && old.heuristic == entry.heuristic) {
+            target = slot;
+            targetDepth = old.depth;
+            break;
+        }
+        int depth = valid ? old.depth : 0;
+        if (depth < targetDepth) {
+            target = slot;
+            targetDepth = depth;
+        }
+    }
+
+    if (targetDepth > entry.depth) return;
+
+    off_t offset = sizeof(CacheHeader) + (off_t) target * sizeof(CacheEntry);
+    if (pwrite(fd, &entry, sizeof(entry), offset) != sizeof(entry)) {
+        perror("cache");
+    }
+}
+
+/*
+ * Writes entries into the cache file. Safe to call from any thread.
+ */
+void PositionCache::write(const vector<CacheEntry> &entries) {
+    if (slots == nullptr || entries.empty()) return;
+
+    lock_guard<mutex> guard(writing);
+    flock(fd, LOCK_EX);
+    for (unsigned int i = 0; i < entries.size(); i++) {
+        writeEntry(entries[i]);
+    }
+    flock(fd, LOCK_UN);
+}
+
+/*
+ * Starts a game's cache on top of the shared one (which may be nullptr).
+ */
+GameCache::GameCache(PositionCache *shared) {
+    this->shared = shared;
+}
+
+/*
+ * Writes out anything new.
+ */
+GameCache::~GameCache() {
+    flush();
+}
+
+/*
+ * Looks up the score of board with toMove to play, searched to at least
+ * depth plies, first in this game's results and then in the shared cache.
+ * Returns true and sets score if there is one.
+ */
+bool GameCache::lookup(Board *board, Side toMove, Side perspective,
+    int depth, bool heuristic, int *score) {
+    uint64_t k = PositionCache::key(board->getDiscs(BLACK),
+        board->getDiscs(WHITE), toMove, perspective);
+
+    auto own = found.find(k);
+    if (own != found.end() && PositionCache::matches(&own->second, board,
+        toMove, perspective, depth, heuristic)) {
+        *score = own->second.score;
+        return true;
+    }
+
+    return shared != nullptr
+        && shared->lookup(board, toMove, perspective, depth, heuristic, score);
+}
+
+/*
+ * Remembers a search result. Deep enough results are written to the shared
+ * cache on the next flush().
+ */
+void GameCache::store(Board *board, Side toMove, Side perspective,
+    int depth, bool heuristic, int score) {
+    // Don't bother if we already know this position at least as deeply.
+    int known;
+    if (lookup(board, toMove, perspective, depth, heuristic, &known)) return;
+
+    CacheEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.black = board->getDiscs(BLACK);
+    entry.white = board->getDiscs(WHITE);
+    entry.score = score;
+    entry.toMove = toMove;
+    entry.perspective = perspective;
+    entry.depth = depth;
+    entry.heuristic = heuristic;
+    entry.check = PositionCache::check(&entry);
+
+    found[PositionCache::key(entry.black, entry.white, toMove, perspective)]
+        = entry;
+    if (depth >= CACHE_PERSIST_DEPTH && shared != nullptr) {
+        unwritten.push_back(entry);
+    }
+}
+
+/*
+ * Writes every deep entry found since the last flush to the shared cache.
+ */
+void GameCache::flush() {
+    if (shared == nullptr || unwritten.empty()) return;
+
+    shared->write(unwritten);
+    unwritten.clear();
+}
@@ -0,0 +1,107 @@
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include "common.hpp"
+#include "board.hpp"
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// Cache file used when OTHELLO_CACHE is not set in the environment.
+#define DEFAULT_CACHE_PATH "gonnapassmaybe.cache"
+
+// Only results searched at least this many plies deep are written to the file.
+#define CACHE_PERSIST_DEPTH 3
+
+// Number of slots in the file's hash table (a power of two). At 32 bytes
+// each this is a 32 MB file, created sparse.
+#define CACHE_SLOTS (1 << 20)
+
+// A position is stored in one of this many slots from where it hashes to.
+#define CACHE_PROBES 8
+
+/*
+ * One cached search result, exactly as it is stored on disk.
+ */
+struct CacheEntry {
+    uint64_t black;
+    uint64_t white;
+    int32_t score;
+    uint8_t toMove;
+    uint8_t perspective;
+    uint8_t depth;
+    uint8_t heuristic;
+    // Hash of all the other fields, so a slot caught half-written by another
+    // process reads as empty rather than as a wrong result.
+    uint64_t check;
+};
+
+/*
+ * Position -> minimax score cache backed by a file that is shared by every
+ * player process on the host. The file is a fixed-size open-addressed hash
+ * table, so it never grows: it is memory-mapped read-only and probed in place
+ * without locking. One PositionCache is opened per process and shared by all
+ * of its games; each game collects its new results in a GameCache.
+ */
+class PositionCache {
+
+private:
+    int fd;
+    char *mapped;
+    const CacheEntry *slots;
+
+    // Serializes writers within this process; flock does it between them.
+    mutex writing;
+
+    static uint64_t check(const CacheEntry *entry);
+    static bool matches(const CacheEntry *entry, Board *board, Side toMove,
+        Side perspective, int depth, bool heuristic);
+    void writeEntry(const CacheEntry &entry);
+
+    friend class GameCache;
+
+public:
+    PositionCache(const char *path, uint64_t fingerprint);
+    ~PositionCache();
+
+    static const char *defaultPath();
+    static uint64_t key(uint64_t black, uint64_t white, int toMove,
+        int perspective);
+
+    bool lookup(Board *board, Side toMove, Side perspective, int depth,
+        bool heuristic, int *score);
+    void write(const vector<CacheEntry> &entries);
+};
+
+/*
+ * One game's view of the cache: everything it has found so far, in memory,
+ * on top of the shared PositionCache. Results deep enough to keep are written
+ * to the shared cache by flush() (replacing shallower results when their
+ * slots are full).
+ */
+class GameCache {
+
+private:
+    // The process's shared cache, or nullptr to keep results in memory only.
+    PositionCache *shared;
+
+    // Entries found by this game.
+    unordered_map<uint64_t, CacheEntry> found;
+
+    // Entries to write to the shared cache on the next flush.
+    vector<CacheEntry> unwritten;
+
+public:
+    GameCache(PositionCache *shared);
+    ~GameCache();
+
+    bool lookup(Board *board, Side toMove, Side perspective, int depth,
+        bool heuristic, int *score);
+    void store(Board *board, Side toMove, Side perspective, int depth,
+        bool heuristic, int score);
+    void flush();
+};
+
+#endif
@@ -0,0 +1,62 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "server.hpp"
+using namespace std;
+
+/*
+ * Per-game shim for the match server. The Java framework starts this exactly
+ * like the normal player ("./gonnapassmaybe-client Black"); it forwards the
+ * side and every stdin line to the server and copies the replies to stdout.
+ */
+int main(int argc, char *argv[]) {
+    // Read in side the player is on.
+    if (argc != 2)  {
+        cerr << "usage: " << argv[0] << " side" << endl;
+        exit(-1);
+    }
+
+    const char *path = socketPath();
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (sockaddr *) &addr, sizeof(addr)) < 0) {
+        perror(path);
+        exit(-1);
+    }
+    FILE *fromServer = fdopen(fd, "r");
+    FILE *toServer = fdopen(dup(fd), "w");
+
+    // Tell the server which side we are and wait for it to set up the game.
+    char line[64];
+    fprintf(toServer, "%s\n", argv[1]);
+    fflush(toServer);
+    if (fgets(line, sizeof(line), fromServer) == nullptr) {
+        cerr << "match server closed the connection" << endl;
+        exit(-1);
+    }
+    cout << line;
+    cout.flush();
+
+    // Relay each turn: one line in, one line back.
+    string request;
+    while (getline(cin, request)) {
+        fprintf(toServer, "%s\n", request.c_str());
+        fflush(toServer);
+        if (fgets(line, sizeof(line), fromServer) == nullptr) break;
+        cout << line;
+        cout.flush();
+    }
+
+    fclose(toServer);
+    fclose(fromServer);
+    return 0;
+}
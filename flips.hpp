@@ -0,0 +1,115 @@
+#ifndef __FLIPS_H__
+#define __FLIPS_H__
+
+#include <cstdint>
+
+/*
+ * Lookup tables for table-driven move generation, all built by the compiler.
+ *
+ * A line is any row, column or diagonal through a square, packed into 8 bits.
+ * For the move's position p on the line and the opponent's discs on it, the
+ * table gives the run of opponent discs on each side of p and the square just
+ * past each run. A run is flipped exactly when that square is ours.
+ */
+struct LineFlips {
+    uint8_t run[2];
+    uint8_t outflank[2];
+};
+
+struct LineFlipTable {
+    LineFlips entries[8][256];
+};
+
+struct SquareTable {
+    uint64_t masks[64];
+};
+
+struct ByteTable {
+    uint64_t masks[256];
+};
+
+constexpr LineFlipTable makeLineFlips() {
+    LineFlipTable table = {};
+    for (int p = 0; p < 8; p++) {
+        for (int opp = 0; opp < 256; opp++) {
+            for (int side = 0; side < 2; side++) {
+                int step = (side == 0) ? -1 : 1;
+                int run = 0;
+                int i = p + step;
+                while (0 <= i && i < 8 && (opp & (1 << i))) {
+                    run |= 1 << i;
+                    i += step;
+                }
+                table.entries[p][opp].run[side] = run;
+                table.entries[p][opp].outflank[side] =
+                    (run != 0 && 0 <= i && i < 8) ? (1 << i) : 0;
+            }
+        }
+    }
+    return table;
+}
+
+// Squares on the a1-h8 direction diagonal (x - y constant) through a square.
+constexpr SquareTable makeDiagonals(int dx) {
+    SquareTable table = {};
+    for (int square = 0; square < 64; square++) {
+        int x = square % 8;
+        int y = square / 8;
+        for (int i = -7; i <= 7; i++) {
+            int sx = x + i * dx;
+            int sy = y + i;
+            if (0 <= sx && sx < 8 && 0 <= sy && sy < 8) {
+                table.masks[square] |= 1ULL << (8 * sy + sx);
+            }
+        }
+    }
+    return table;
+}
+
+// Spreads a column's 8 bits (bit i = row i) back down column 0.
+constexpr ByteTable makeColumns() {
+    ByteTable table = {};
+    for (int line = 0; line < 256; line++) {
+        for (int y = 0; y < 8; y++) {
+            if (line & (1 << y)) table.masks[line] |= 1ULL << (8 * y);
+        }
+    }
+    return table;
+}
+
+// Squares touching a square, in any of the 8 directions.
+constexpr SquareTable makeNeighbours() {
+    SquareTable table = {};
+    for (int square = 0; square < 64; square++) {
+        int x = square % 8;
+        int y = square / 8;
+        for (int dx = -1; dx <= 1; dx++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                if (dx == 0 && dy == 0) continue;
+                if (0 <= x + dx && x + dx < 8 && 0 <= y + dy && y + dy < 8) {
+                    table.masks[square] |= 1ULL << (8 * (y + dy) + x + dx);
+                }
+            }
+        }
+    }
+    return table;
+}
+
+constexpr LineFlipTable LINE_FLIPS = makeLineFlips();
+constexpr SquareTable DIAGONALS = makeDiagonals(1);
+constexpr SquareTable ANTI_DIAGONALS = makeDiagonals(-1);
+constexpr ByteTable COLUMNS = makeColumns();
+constexpr SquareTable NEIGHBOURS = makeNeighbours();
+
+/*
+ * Returns the discs of one line that a move at p flips, given our discs and
+ * the opponent's discs on that line.
+ */
+inline uint8_t lineFlips(int p, uint8_t own, uint8_t opp) {
+    const LineFlips &line = LINE_FLIPS.entries[p][opp];
+    uint8_t lower = -(uint8_t) ((own & line.outflank[0]) != 0);
+    uint8_t upper = -(uint8_t) ((own & line.outflank[1]) != 0);
+    return (line.run[0] & lower) | (line.run[1] & upper);
+}
+
+#endif
@@ -1,13 +1,31 @@
 #include "player.hpp"
 
+/*
+ * Heuristic scores for each spot on the board. This is read-only, so it is
+ * shared by every Player (and every game in the match server).
+ */
+const int Player::heuristic_values[8][8] = {
+    {100, -50, 25, 25, 25, 25, -50, 100},
+    {-50, -75,  0,  0,  0,  0, -75, -50},
+    { 25,   0,  0,  0,  0,  0,   0,  25},
+    { 15,   0,  0,  0,  0,  0,   0,  15},
+    { 15,   0,  0,  0,  0,  0,   0,  15},
+    { 25,   0,  0,  0,  0,  0,   0,  25},
+    {-50, -75,  0,  0,  0,  0, -75, -50},
+    {100, -50, 25, 25, 25, 25, -50, 100}};
+
 /*
  * Constructor for the player; initialize everything here. The side your AI is
  * on (BLACK or WHITE) is passed in as "side". The constructor must finish
  * within 30 seconds.
+ *
+ * Search results are shared with other games through the process's
+ * PositionCache; pass nullptr to keep them in memory only.
  */
-Player::Player(Side s) {
+Player::Player(Side s, PositionCache *shared) {
     // Will be set to true in test_minimax.cpp.
     testingMinimax = false;
+    nodes = 0;
 
     // define the color of your side and opponent's side
     side = s;
@@ -15,12 +33,35 @@ Player::Player(Side s) {
 
     // initialize board
     board = new Board();
+
+    // this game's results, on top of those shared with other games
+    cache = new GameCache(shared);
+}
+
+/*
+ * Identifies how this build scores positions: a hash of the heuristic values
+ * and SEARCH_VERSION. Cache files made with a different fingerprint are
+ * replaced, since their scores can't be trusted.
+ */
+uint64_t Player::cacheFingerprint() {
+    // FNV-1a
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) {
+            h = (h ^ (uint32_t) heuristic_values[y][x]) * 0x100000001B3ULL;
+        }
+    }
+    h = (h ^ SEARCH_VERSION) * 0x100000001B3ULL;
+    return h;
 }
 
 /*
  * Destructor for the player.
  */
 Player::~Player() {
+    // delete the cache first so new results are written out
+    delete cache;
+    delete board;
 }
 
 /*
@@ -43,6 +84,7 @@ Move *Player::doMove(Move *opponentsMove, int msLeft) {
   	// get all valid moves - if there are none, just return nullptr
   	vector<Move*> available = board->getMoves(side);
   	if (available.size() == 0) {
+  		cache->flush();
   		return nullptr;
   	}
 
@@ -53,15 +95,34 @@ Move *Player::doMove(Move *opponentsMove, int msLeft) {
 
     // Before returning, perform the move.
     board->doMove(nextMove, side);
+
+    // Save what this search learned now. The framework may kill us as soon as
+    // the game ends, so we can't count on a clean exit to do it.
+    cache->flush();
     return nextMove;
 
 }
 
+/*
+ * Searches the current board to the given depth without playing a move.
+ * Returns the best move (nullptr if there are none) and sets score to its
+ * minimax score. With heuristic false and depth at least the number of
+ * empty squares, the score is the exact final disc difference.
+ */
+Move *Player::search(int depth, bool heuristic, int *score) {
+    vector<Move*> available = board->getMoves(side);
+    if (available.size() == 0) {
+        *score = calcScore(board);
+        return nullptr;
+    }
+    return doMoveMinimax(available, depth, -1, heuristic, score);
+}
+
 /**
  * Computes next move using Minimax algorithm.
  * Assumes the vector moves has > 0 size.
  */
-Move *Player::doMoveMinimax(vector<Move*> available, int depth, int msLeft, bool heuristic)
+Move *Player::doMoveMinimax(vector<Move*> available, int depth, int msLeft, bool heuristic, int *score)
 {
     Move* bestMove = available[0];
     // NOTE: setting use_heuristic to true, so heuristic function
@@ -86,6 +147,9 @@ Move *Player::doMoveMinimax(vector<Move*> available, int depth, int msLeft, bool
             delete available[i];
         }
     }
+    if (score != nullptr) {
+        *score = minimax;
+    }
     return bestMove;
 }
 
@@ -97,12 +161,33 @@ Move *Player::doMoveMinimax(vector<Move*> available, int depth, int msLeft, bool
 // true if using heuristc function
 int Player::calcMinScore(Board *copy, Move *move, Side side, int depth, bool heuristic, bool getMin)
 {
+    nodes++;
+
     // Do the move.
     copy->doMove(move, side);
 
     Side other = (side == BLACK) ? WHITE : BLACK;
+
+    // Reuse the score if this position has been searched deeply before.
+    int cached;
+    if (depth >= CACHE_MIN_DEPTH
+        && cache->lookup(copy, other, this->side, depth, heuristic, &cached)) {
+        delete copy;
+        return cached;
+    }
+
     vector<Move*> available = copy->getMoves(other);
 
+    // If the other side has to pass, this side moves again, so its moves are
+    // the ones to look at (min for the opponent, max for us).
+    Side next = other;
+    bool minimize = getMin;
+    if (depth > 0 && available.size() == 0) {
+        available = copy->getMoves(side);
+        next = side;
+        minimize = !getMin;
+    }
+
     // Base case.
     if (depth <= 0 || available.size() == 0) {
         int score;
@@ -124,17 +209,21 @@ int Player::calcMinScore(Board *copy, Move *move, Side side, int depth, bool heu
     // Otherwise, recursively call this function for every available move.
     // First, get all vailable moves.
     else {
-		int minmaxscore = calcMinScore(copy->copy(), available[0], other, depth-1, heuristic, !getMin);
+		int minmaxscore = calcMinScore(copy->copy(), available[0], next, depth-1, heuristic, !minimize);
 		for (unsigned int i = 1; i < available.size(); i++) {
-			int score = calcMinScore(copy->copy(), available[i], other, depth-1, heuristic, !getMin);
-			if (getMin && (score < minmaxscore)) {
+			int score = calcMinScore(copy->copy(), available[i], next, depth-1, heuristic, !minimize);
+			if (minimize && (score < minmaxscore)) {
 				minmaxscore = score;
 			}
-			else if (!getMin && (score > minmaxscore)){
+			else if (!minimize && (score > minmaxscore)){
 				minmaxscore = score;
 			}
 		}
 
+		if (depth >= CACHE_MIN_DEPTH) {
+			cache->store(copy, other, this->side, depth, heuristic, minmaxscore);
+		}
+
 		// Free memory.
 		delete copy;
 		for (unsigned int i = 0; i < available.size(); i++) {
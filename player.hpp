@@ -5,6 +5,7 @@
 #include <thread>
 #include "common.hpp"
 #include "board.hpp"
+#include "cache.hpp"
 using namespace std;
 
 class Player {
@@ -13,30 +14,36 @@ private:
     Side side;
     Side opponentsSide;
 
-    // initialize array containing heuristic scores for each spot on board
+    // array containing heuristic scores for each spot on board
     // NOTE: used random values here, should figure out optimal ones
-    int heuristic_values[8][8] = {
-    {100, -50, 25, 25, 25, 25, -50, 100},
-    {-50, -75,  0,  0,  0,  0, -75, -50},
-    { 25,   0,  0,  0,  0,  0,   0,  25},
-    { 15,   0,  0,  0,  0,  0,   0,  15},
-    { 15,   0,  0,  0,  0,  0,   0,  15},
-    { 25,   0,  0,  0,  0,  0,   0,  25},
-    {-50, -75,  0,  0,  0,  0, -75, -50},
-    {100, -50, 25, 25, 25, 25, -50, 100}};
-
-    Move *doMoveMinimax(vector<Move*> moves, int depth, int msLeft, bool heuristic);
+    // NOTE: static so every game in the match server shares one copy
+    static const int heuristic_values[8][8];
+
+    // Scores searched at least this many plies deep are saved in the cache.
+    static const int CACHE_MIN_DEPTH = 2;
+
+    // Bump this whenever a change to the search changes the scores it gives,
+    // so cache files written by older builds are thrown away.
+    static const int SEARCH_VERSION = 1;
+
+    Move *doMoveMinimax(vector<Move*> moves, int depth, int msLeft, bool heuristic, int *score = nullptr);
     int calcHeuristicScore(Board *board);
 
 public:
     Board *board;
+    GameCache *cache;
 
-    Player(Side side);
+    Player(Side side, PositionCache *shared = nullptr);
     ~Player();
 
+    static uint64_t cacheFingerprint();
+
     int calcScore(Board *board);
     int calcMinScore(Board *copy, Move *move, Side side, int depth, bool heuristic, bool getMin);
     Move *doMove(Move *opponentsMove, int msLeft);
+    Move *search(int depth, bool heuristic, int *score);
+    // Number of positions calcMinScore has visited, for benchmarking
+    unsigned long nodes;
     // Flag to tell if the player is running within the test_minimax context
     bool testingMinimax;
 };
@@ -0,0 +1,383 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <set>
+#include <signal.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "player.hpp"
+#include "server.hpp"
+using namespace std;
+
+// Games with no time limit (msLeft = -1) are scheduled as if they had this
+// many ms left, so they still get a turn while timed games keep arriving.
+#define UNTIMED_MS 10000
+
+// How long to wait before accepting again when out of descriptors or memory.
+#define ACCEPT_RETRY_MS 100
+
+/*
+ * A single move request from one game, waiting to be run on the pool.
+ */
+struct Job {
+    Player *player;
+    Move *opponentsMove;
+    int msLeft;
+    unsigned long order;
+    // When the game's clock would run out, in ms since the scheduler started.
+    long deadline;
+    Move *result = nullptr;
+    bool done = false;
+};
+
+/*
+ * Orders jobs by deadline, i.e. the time they were queued plus the time left
+ * on their game's clock, so the game closest to running out goes first. A job
+ * that has waited long enough beats anything queued after it. Ties are broken
+ * by arrival order.
+ */
+struct JobOrder {
+    bool operator()(Job *a, Job *b) {
+        if (a->deadline != b->deadline) return a->deadline > b->deadline;
+        return a->order > b->order;
+    }
+};
+
+/*
+ * A fixed pool of worker threads shared by every game the server is running.
+ */
+class Scheduler {
+
+private:
+    mutex lock;
+    condition_variable queued;
+    condition_variable finished;
+    priority_queue<Job*, vector<Job*>, JobOrder> jobs;
+    vector<thread> workers;
+    chrono::steady_clock::time_point started;
+    unsigned long submitted = 0;
+    bool stopping = false;
+
+    void work();
+
+public:
+    Scheduler(int threads);
+    ~Scheduler();
+
+    bool run(Player *player, Move *opponentsMove, int msLeft, Move **result);
+    void stop();
+};
+
+Scheduler::Scheduler(int threads) {
+    started = chrono::steady_clock::now();
+
+    for (int i = 0; i < threads; i++) {
+        workers.push_back(thread(&Scheduler::work, this));
+    }
+}
+
+Scheduler::~Scheduler() {
+    stop();
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+}
+
+/*
+ * Stops taking new jobs. Jobs already queued are still run, so nobody is
+ * left waiting on them; the workers exit once the queue is empty.
+ */
+void Scheduler::stop() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    queued.notify_all();
+}
+
+/*
+ * Queues a move for the given game and blocks until a worker has computed
+ * the player's reply, which is put in result. Returns false without running
+ * anything if the scheduler is stopping.
+ */
+bool Scheduler::run(Player *player, Move *opponentsMove, int msLeft,
+    Move **result) {
+    Job job;
+    job.player = player;
+    job.opponentsMove = opponentsMove;
+    job.msLeft = msLeft;
+
+    long now = chrono::duration_cast<chrono::milliseconds>(
+        chrono::steady_clock::now() - started).count();
+    job.deadline = now + ((msLeft < 0) ? UNTIMED_MS : msLeft);
+
+    unique_lock<mutex> guard(lock);
+    if (stopping) return false;
+    job.order = submitted++;
+    jobs.push(&job);
+    queued.notify_one();
+
+    finished.wait(guard, [&job] { return job.done; });
+    *result = job.result;
+    return true;
+}
+
+/*
+ * Worker loop: repeatedly takes the most urgent job and runs it.
+ */
+void Scheduler::work() {
+    while (true) {
+        Job *job;
+        {
+            unique_lock<mutex> guard(lock);
+            queued.wait(guard, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) return;
+            job = jobs.top();
+            jobs.pop();
+        }
+
+        // Each game has its own Player, so no lock is needed while searching.
+        Move *result = job->player->doMove(job->opponentsMove, job->msLeft);
+
+        {
+            lock_guard<mutex> guard(lock);
+            job->result = result;
+            job->done = true;
+        }
+        finished.notify_all();
+    }
+}
+
+/*
+ * Sockets of the games in progress, so they can be shut down with the server.
+ */
+static mutex sessionsLock;
+static condition_variable sessionsDone;
+static set<int> sessions;
+
+/*
+ * SIGINT and SIGTERM write to this pipe, which wakes up the accept loop so the
+ * server can shut down cleanly.
+ */
+static int stopPipe[2];
+
+static void requestStop(int) {
+    int saved = errno;
+    if (write(stopPipe[1], "", 1) < 0) {
+        // Already full, so a stop is already pending.
+    }
+    errno = saved;
+}
+
+/*
+ * Writes a whole line to the socket, returning false if the client is gone.
+ */
+static bool sendLine(int fd, string line) {
+    line += "\n";
+    const char *data = line.c_str();
+    size_t left = line.size();
+    while (left > 0) {
+        ssize_t n = write(fd, data, left);
+        if (n <= 0) return false;
+        data += n;
+        left -= n;
+    }
+    return true;
+}
+
+/*
+ * Plays one game over an accepted connection. The protocol is the same one
+ * the Java framework speaks to wrapper.cpp over stdin/stdout: the client
+ * first sends the side ("Black" or "White") and waits for "Init done", then
+ * sends "x y msLeft" for every turn and reads back "x y" ("-1 -1" to pass).
+ */
+static void playSession(Scheduler *scheduler, PositionCache *cache, int fd) {
+    FILE *in = fdopen(dup(fd), "r");
+    if (in == nullptr) return;
+
+    char sideName[16];
+    if (fscanf(in, "%15s", sideName) != 1) {
+        fclose(in);
+        return;
+    }
+    Side side = (!strcmp(sideName, "Black")) ? BLACK : WHITE;
+
+    Player *player = new Player(side, cache);
+    bool connected = sendLine(fd, "Init done");
+
+    int moveX, moveY, msLeft;
+    while (connected && fscanf(in, "%d %d %d", &moveX, &moveY, &msLeft) == 3) {
+        Move *opponentsMove = nullptr;
+        if (moveX >= 0 && moveY >= 0) {
+            opponentsMove = new Move(moveX, moveY);
+        }
+
+        Move *playersMove = nullptr;
+        if (!scheduler->run(player, opponentsMove, msLeft, &playersMove)) {
+            connected = false;
+        }
+        else if (playersMove != nullptr) {
+            connected = sendLine(fd, to_string(playersMove->x) + " "
+                + to_string(playersMove->y));
+        } else {
+            connected = sendLine(fd, "-1 -1");
+        }
+
+        // Delete move objects.
+        if (opponentsMove != nullptr) delete opponentsMove;
+        if (playersMove != nullptr) delete playersMove;
+    }
+
+    delete player;
+    fclose(in);
+}
+
+/*
+ * Runs one game on its own thread, keeping its socket registered in sessions
+ * while it plays.
+ */
+static void runSession(Scheduler *scheduler, PositionCache *cache, int fd) {
+    playSession(scheduler, cache, fd);
+
+    lock_guard<mutex> guard(sessionsLock);
+    sessions.erase(fd);
+    close(fd);
+    sessionsDone.notify_all();
+}
+
+int main(int argc, char *argv[]) {
+    // Read in the number of worker threads, defaulting to one per core.
+    if (argc > 2) {
+        cerr << "usage: " << argv[0] << " [threads]" << endl;
+        exit(-1);
+    }
+    int threads = (argc == 2) ? atoi(argv[1]) : thread::hardware_concurrency();
+    if (threads <= 0) threads = 1;
+
+    // A client hanging up mid-write should end its session, not the server.
+    signal(SIGPIPE, SIG_IGN);
+
+    // Interrupting or killing the server stops it accepting new games.
+    if (pipe(stopPipe) < 0) {
+        perror("pipe");
+        exit(-1);
+    }
+    fcntl(stopPipe[1], F_SETFL, O_NONBLOCK);
+    struct sigaction stop;
+    memset(&stop, 0, sizeof(stop));
+    stop.sa_handler = requestStop;
+    stop.sa_flags = SA_RESTART;
+    sigemptyset(&stop.sa_mask);
+    sigaction(SIGINT, &stop, nullptr);
+    sigaction(SIGTERM, &stop, nullptr);
+
+    const char *path = socketPath();
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        cerr << "socket path too long: " << path << endl;
+        exit(-1);
+    }
+    strcpy(addr.sun_path, path);
+
+    // Only remove a socket left behind by a server that is gone: if something
+    // still accepts connections on it, leave it alone.
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0) {
+        perror("socket");
+        exit(-1);
+    }
+    if (connect(probe, (sockaddr *) &addr, sizeof(addr)) == 0) {
+        cerr << "a server is already listening on " << path << endl;
+        exit(-1);
+    }
+    if (errno == ECONNREFUSED) {
+        unlink(path);
+    }
+    else if (errno != ENOENT) {
+        perror(path);
+        exit(-1);
+    }
+    close(probe);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0
+        || bind(listener, (sockaddr *) &addr, sizeof(addr)) < 0
+        || listen(listener, SOMAXCONN) < 0) {
+        perror(path);
+        exit(-1);
+    }
+    // A connection can go away between poll and accept; don't block on it.
+    fcntl(listener, F_SETFL, O_NONBLOCK);
+    cerr << "Listening on " << path << " with " << threads << " threads"
+        << endl;
+
+    // One read-only view of the position cache for every game; each game
+    // keeps its own new results until it flushes them.
+    PositionCache cache(PositionCache::defaultPath(),
+        Player::cacheFingerprint());
+    Scheduler scheduler(threads);
+
+    // Every connection is one game. Keep accepting until told to stop.
+    pollfd waiting[2];
+    waiting[0].fd = listener;
+    waiting[0].events = POLLIN;
+    waiting[1].fd = stopPipe[0];
+    waiting[1].events = POLLIN;
+    while (true) {
+        if (poll(waiting, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("poll");
+            break;
+        }
+        if (waiting[1].revents != 0) break;
+        if (waiting[0].revents == 0) continue;
+
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == ECONNABORTED) {
+                continue;
+            }
+            // Out of descriptors or memory: running games will free some up,
+            // so wait a little rather than spin on the pending connection.
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS
+                || errno == ENOMEM) {
+                perror("accept");
+                usleep(ACCEPT_RETRY_MS * 1000);
+                continue;
+            }
+            perror("accept");
+            break;
+        }
+        {
+            lock_guard<mutex> guard(sessionsLock);
+            sessions.insert(fd);
+        }
+        thread(runSession, &scheduler, &cache, fd).detach();
+    }
+
+    close(listener);
+    unlink(path);
+
+    // Let queued moves finish, then hang up on every game and wait for the
+    // session threads to exit before the scheduler goes away.
+    scheduler.stop();
+    {
+        unique_lock<mutex> guard(sessionsLock);
+        for (int fd : sessions) {
+            shutdown(fd, SHUT_RDWR);
+        }
+        sessionsDone.wait(guard, [] { return sessions.empty(); });
+    }
+    return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+#include <cstdlib>
+
+// Unix domain socket the match server listens on when OTHELLO_SOCKET is not
+// set in the environment.
+#define DEFAULT_SOCKET_PATH "/tmp/gonnapassmaybe.sock"
+
+/*
+ * Returns the path of the match server's socket.
+ */
+inline const char *socketPath() {
+    const char *path = getenv("OTHELLO_SOCKET");
+    return (path != nullptr && *path != '\0') ? path : DEFAULT_SOCKET_PATH;
+}
+
+#endif
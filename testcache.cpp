@@ -0,0 +1,357 @@
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "common.hpp"
+#include "board.hpp"
+#include "cache.hpp"
+
+// Use this file to check the shared position cache file: results surviving a
+// reopen, which results are kept when a probe range fills up, damaged slots
+// reading as empty, incompatible files being replaced and two processes
+// writing to one file at once.
+
+#define FINGERPRINT 1
+
+// Positions each process writes in the concurrent test, and how often it
+// flushes them.
+#define WRITER_POSITIONS 500
+#define WRITER_FLUSH_EVERY 50
+
+static int errors = 0;
+
+static void fail(string what) {
+    std::cout << "FAILED: " << what << std::endl;
+    errors++;
+}
+
+static uint64_t random64() {
+    return ((uint64_t) rand() << 62) ^ ((uint64_t) rand() << 31) ^ rand();
+}
+
+/*
+ * Makes a random position (not necessarily reachable in a game).
+ */
+static void randomPosition(uint64_t *black, uint64_t *white) {
+    *black = random64() & random64();
+    *white = random64() & random64() & ~*black;
+}
+
+static Board *makeBoard(uint64_t black, uint64_t white) {
+    char data[8][8];
+    for (int i = 0; i < 64; i++) {
+        data[i / 8][i % 8] = ((black >> i) & 1) ? 'b'
+            : ((white >> i) & 1) ? 'w' : '-';
+    }
+    Board *board = new Board();
+    board->setBoard(data);
+    return board;
+}
+
+/*
+ * Returns count positions that all hash to the same slot, so they compete
+ * for the same CACHE_PROBES slots in the file.
+ */
+static vector<Board*> collidingBoards(int count) {
+    const int tries = 2 * CACHE_SLOTS;
+    vector<uint8_t> hits(CACHE_SLOTS, 0);
+
+    srand(3);
+    for (int i = 0; i < tries; i++) {
+        uint64_t black, white;
+        randomPosition(&black, &white);
+        uint64_t home = PositionCache::key(black, white, BLACK, BLACK)
+            & (CACHE_SLOTS - 1);
+        if (hits[home] < 255) hits[home]++;
+    }
+    unsigned int target = 0;
+    while (target < hits.size() && hits[target] < count) target++;
+
+    // Generate the same positions again, keeping the ones in that slot.
+    vector<Board*> boards;
+    srand(3);
+    for (int i = 0; i < tries && (int) boards.size() < count; i++) {
+        uint64_t black, white;
+        randomPosition(&black, &white);
+        uint64_t home = PositionCache::key(black, white, BLACK, BLACK)
+            & (CACHE_SLOTS - 1);
+        if (home == target) boards.push_back(makeBoard(black, white));
+    }
+    return boards;
+}
+
+/*
+ * Writes one result to the file through a game's cache.
+ */
+static void storeOne(PositionCache *shared, Board *board, int depth,
+    int score) {
+    GameCache game(shared);
+    game.store(board, BLACK, BLACK, depth, true, score);
+    game.flush();
+}
+
+static bool hasScore(PositionCache *shared, Board *board, int depth,
+    int score) {
+    int found;
+    return shared->lookup(board, BLACK, BLACK, depth, true, &found)
+        && found == score;
+}
+
+/*
+ * Deep results written by one PositionCache are there after reopening the
+ * file; shallow ones are not written at all.
+ */
+static void testReopen(const char *path) {
+    Board *deep = new Board();
+    Board *shallow = new Board();
+    Move move(3, 2);
+    shallow->doMove(&move, BLACK);
+
+    PositionCache *shared = new PositionCache(path, FINGERPRINT);
+    GameCache *game = new GameCache(shared);
+    game->store(deep, BLACK, BLACK, CACHE_PERSIST_DEPTH, true, 42);
+    game->store(shallow, WHITE, WHITE, CACHE_PERSIST_DEPTH - 1, true, 7);
+    game->flush();
+    delete game;
+    delete shared;
+
+    shared = new PositionCache(path, FINGERPRINT);
+    if (!hasScore(shared, deep, CACHE_PERSIST_DEPTH, 42)) {
+        fail("deep result lost on reopen");
+    }
+    int score;
+    if (shared->lookup(deep, BLACK, BLACK, CACHE_PERSIST_DEPTH + 1, true,
+        &score)) {
+        fail("result used for a deeper search");
+    }
+    if (shared->lookup(deep, WHITE, BLACK, CACHE_PERSIST_DEPTH, true, &score)
+        || shared->lookup(deep, BLACK, BLACK, CACHE_PERSIST_DEPTH, false,
+        &score)) {
+        fail("result used for a different side or search");
+    }
+    if (shared->lookup(shallow, WHITE, WHITE, 1, true, &score)) {
+        fail("shallow result was written");
+    }
+    delete shared;
+    delete deep;
+    delete shallow;
+}
+
+/*
+ * When every slot a position can go in is taken, the shallowest result is
+ * replaced, but never by a shallower one.
+ */
+static void testReplacement(const char *path) {
+    vector<Board*> boards = collidingBoards(CACHE_PROBES + 2);
+    if ((int) boards.size() < CACHE_PROBES + 2) {
+        fail("could not find colliding positions");
+        return;
+    }
+    Board *extra = boards[CACHE_PROBES];
+    Board *last = boards[CACHE_PROBES + 1];
+    PositionCache *shared = new PositionCache(path, FINGERPRINT);
+
+    // Fill the probe range.
+    for (int i = 0; i < CACHE_PROBES; i++) {
+        storeOne(shared, boards[i], 3, i);
+    }
+    for (int i = 0; i < CACHE_PROBES; i++) {
+        if (!hasScore(shared, boards[i], 3, i)) fail("probe range not filled");
+    }
+
+    // A deeper result takes one of the slots.
+    storeOne(shared, extra, 5, 100);
+    int kept = 0;
+    for (int i = 0; i < CACHE_PROBES; i++) {
+        if (hasScore(shared, boards[i], 3, i)) kept++;
+    }
+    if (!hasScore(shared, extra, 5, 100) || kept != CACHE_PROBES - 1) {
+        fail("deeper result did not replace a shallower one");
+    }
+
+    // Once every slot is deeper, a shallower result is dropped.
+    for (int i = 0; i < CACHE_PROBES; i++) {
+        storeOne(shared, boards[i], 6, i);
+    }
+    storeOne(shared, last, 4, 200);
+    int score;
+    if (shared->lookup(last, BLACK, BLACK, 1, true, &score)) {
+        fail("shallower result replaced a deeper one");
+    }
+    if (shared->lookup(extra, BLACK, BLACK, 1, true, &score)) {
+        fail("shallowest result was not the one replaced");
+    }
+
+    // A deeper result for a position already there goes in its own slot.
+    storeOne(shared, boards[2], 7, 300);
+    for (int i = 0; i < CACHE_PROBES; i++) {
+        if (!hasScore(shared, boards[i], 6, (i == 2) ? 300 : i)) {
+            fail("deeper result did not replace its own slot");
+        }
+    }
+
+    delete shared;
+    for (unsigned int i = 0; i < boards.size(); i++) {
+        delete boards[i];
+    }
+}
+
+/*
+ * A slot whose checksum doesn't match reads as empty and can be reused.
+ */
+static void testCorruption(const char *path) {
+    Board *board = new Board();
+    Move move(2, 3);
+    board->doMove(&move, BLACK);
+    PositionCache *shared = new PositionCache(path, FINGERPRINT);
+    storeOne(shared, board, 4, 55);
+    if (!hasScore(shared, board, 4, 55)) fail("result not written");
+
+    // Find the slot and change its score without updating the checksum.
+    int fd = open(path, O_RDWR);
+    struct stat st;
+    fstat(fd, &st);
+    off_t start = st.st_size - (off_t) CACHE_SLOTS * sizeof(CacheEntry);
+    vector<CacheEntry> slots(CACHE_SLOTS);
+    if (pread(fd, slots.data(), CACHE_SLOTS * sizeof(CacheEntry), start)
+        != (ssize_t) (CACHE_SLOTS * sizeof(CacheEntry))) {
+        fail("could not read cache file");
+    }
+    int corrupted = 0;
+    for (int i = 0; i < CACHE_SLOTS; i++) {
+        if (slots[i].black == board->getDiscs(BLACK)
+            && slots[i].white == board->getDiscs(WHITE)) {
+            slots[i].score++;
+            pwrite(fd, &slots[i], sizeof(CacheEntry),
+                start + (off_t) i * sizeof(CacheEntry));
+            corrupted++;
+        }
+    }
+    close(fd);
+    if (corrupted != 1) fail("result not found in the file");
+
+    int score;
+    if (shared->lookup(board, BLACK, BLACK, 4, true, &score)) {
+        fail("corrupted slot was read");
+    }
+    storeOne(shared, board, 3, 56);
+    if (!hasScore(shared, board, 3, 56)) {
+        fail("corrupted slot was not treated as empty");
+    }
+    delete shared;
+    delete board;
+}
+
+/*
+ * A file of the wrong size or with another fingerprint is replaced by an
+ * empty, working one.
+ */
+static void testIncompatible(const char *path) {
+    Board *board = new Board();
+    PositionCache *shared = new PositionCache(path, FINGERPRINT);
+    storeOne(shared, board, 5, 9);
+    delete shared;
+
+    shared = new PositionCache(path, FINGERPRINT + 1);
+    int score;
+    if (shared->lookup(board, BLACK, BLACK, 5, true, &score)) {
+        fail("result used with a different fingerprint");
+    }
+    storeOne(shared, board, 5, 10);
+    if (!hasScore(shared, board, 5, 10)) {
+        fail("replaced file is not usable");
+    }
+    delete shared;
+
+    int fd = open(path, O_WRONLY | O_TRUNC);
+    if (write(fd, "junk", 4) != 4) fail("could not write junk");
+    close(fd);
+    shared = new PositionCache(path, FINGERPRINT);
+    storeOne(shared, board, 5, 11);
+    if (!hasScore(shared, board, 5, 11)) fail("junk file was not replaced");
+    delete shared;
+    delete board;
+}
+
+/*
+ * Writes WRITER_POSITIONS random results to the file, flushing as it goes.
+ */
+static void writer(const char *path, int seed) {
+    srand(seed);
+    PositionCache shared(path, FINGERPRINT);
+    GameCache game(&shared);
+    for (int i = 0; i < WRITER_POSITIONS; i++) {
+        uint64_t black, white;
+        randomPosition(&black, &white);
+        Board *board = makeBoard(black, white);
+        game.store(board, BLACK, BLACK, 3, true, seed * 1000 + i);
+        delete board;
+        if (i % WRITER_FLUSH_EVERY == WRITER_FLUSH_EVERY - 1) game.flush();
+    }
+}
+
+/*
+ * Two processes flushing to the same file at once lose nothing.
+ */
+static void testConcurrent(const char *path) {
+    // Create the file first, so both writers open the same one.
+    delete new PositionCache(path, FINGERPRINT);
+
+    pid_t children[2];
+    for (int i = 0; i < 2; i++) {
+        children[i] = fork();
+        if (children[i] == 0) {
+            writer(path, i + 1);
+            _exit(0);
+        }
+    }
+    for (int i = 0; i < 2; i++) {
+        int status;
+        waitpid(children[i], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fail("writer process failed");
+        }
+    }
+
+    PositionCache shared(path, FINGERPRINT);
+    for (int seed = 1; seed <= 2; seed++) {
+        srand(seed);
+        for (int i = 0; i < WRITER_POSITIONS; i++) {
+            uint64_t black, white;
+            randomPosition(&black, &white);
+            Board *board = makeBoard(black, white);
+            if (!hasScore(&shared, board, 3, seed * 1000 + i)) {
+                fail("result " + to_string(i) + " from writer "
+                    + to_string(seed) + " missing");
+            }
+            delete board;
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    string base = (argc > 1) ? argv[1]
+        : "/tmp/testcache." + to_string(getpid());
+    const char *tests[] = {"reopen", "replacement", "corruption",
+        "incompatible", "concurrent"};
+    void (*runs[])(const char *) = {testReopen, testReplacement,
+        testCorruption, testIncompatible, testConcurrent};
+
+    for (int i = 0; i < 5; i++) {
+        string path = base + "." + tests[i];
+        unlink(path.c_str());
+        int before = errors;
+        runs[i](path.c_str());
+        unlink(path.c_str());
+        if (errors > before) std::cout << tests[i] << " failed" << std::endl;
+    }
+
+    if (errors == 0) {
+        std::cout << "Cache file behaves correctly" << std::endl;
+    }
+    return errors == 0 ? 0 : 1;
+}
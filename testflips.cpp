@@ -0,0 +1,113 @@
+#include <iostream>
+#include <cstdlib>
+#include "common.hpp"
+#include "board.hpp"
+
+// Use this file to check the table-driven Board::doMove and Board::checkMove
+// against the square-by-square Board::doMoveReference over random games, and
+// the incrementally kept frontier against a full scan.
+int main(int argc, char *argv[]) {
+    int games = (argc > 1) ? atoi(argv[1]) : 1000;
+    int errors = 0;
+    srand(2);
+
+    for (int game = 0; game < games && errors == 0; game++) {
+        Board *board = new Board();
+        Board *reference = new Board();
+        Side side = BLACK;
+
+        while (!board->isDone() && errors == 0) {
+            // Legality must agree on every square.
+            vector<Move*> available;
+            for (int y = 0; y < 8; y++) {
+                for (int x = 0; x < 8; x++) {
+                    Move *move = new Move(x, y);
+                    Capture capture = reference->checkMoveCapture(move, side);
+                    for (unsigned int i = 0; i < capture.captures.size(); i++) {
+                        delete capture.captures[i];
+                    }
+                    if (board->checkMove(move, side) != capture.valid) {
+                        std::cout << "Legality differs at (" << x << ", " << y
+                            << ") in game " << game << std::endl;
+                        errors++;
+                    }
+                    if (capture.valid) {
+                        available.push_back(move);
+                    } else {
+                        delete move;
+                    }
+                }
+            }
+
+            // Play a random legal move (or pass) on both boards.
+            Move *move = nullptr;
+            if (available.size() > 0) {
+                move = available[rand() % available.size()];
+            }
+            board->doMove(move, side);
+            reference->doMoveReference(move, side);
+
+            // The boards must then be identical.
+            for (int y = 0; y < 8; y++) {
+                for (int x = 0; x < 8; x++) {
+                    if (board->get(x, y) != reference->get(x, y)) errors++;
+                }
+            }
+
+            // The frontier must be exactly the empty squares next to a disc,
+            // and potential mobility the ones next to the other side's discs.
+            uint64_t frontier = 0;
+            int mobility[3] = {0, 0, 0};
+            for (int y = 0; y < 8; y++) {
+                for (int x = 0; x < 8; x++) {
+                    if (board->get(x, y) != EMPTY) continue;
+                    bool touches[3] = {false, false, false};
+                    for (int dx = -1; dx <= 1; dx++) {
+                        for (int dy = -1; dy <= 1; dy++) {
+                            int nx = x + dx;
+                            int ny = y + dy;
+                            if (0 <= nx && nx < 8 && 0 <= ny && ny < 8) {
+                                touches[board->get(nx, ny)] = true;
+                            }
+                        }
+                    }
+                    if (touches[WHITE] || touches[BLACK]) {
+                        frontier |= 1ULL << (8 * y + x);
+                    }
+                    if (touches[WHITE]) mobility[BLACK]++;
+                    if (touches[BLACK]) mobility[WHITE]++;
+                }
+            }
+            if (board->getFrontier() != frontier
+                || board->potentialMobility(BLACK) != mobility[BLACK]
+                || board->potentialMobility(WHITE) != mobility[WHITE]) {
+                std::cout << "Frontier differs in game " << game << std::endl;
+                errors++;
+            }
+            if (board->countBlack() != reference->countBlack()
+                || board->countWhite() != reference->countWhite()
+                || board->countEmpty() != reference->countEmpty()) {
+                errors++;
+            }
+            if (errors > 0) {
+                std::cout << "Boards differ in game " << game << std::endl;
+                board->printBoard();
+                reference->printBoard();
+            }
+
+            for (unsigned int i = 0; i < available.size(); i++) {
+                delete available[i];
+            }
+            side = (side == BLACK) ? WHITE : BLACK;
+        }
+
+        delete board;
+        delete reference;
+    }
+
+    if (errors == 0) {
+        std::cout << "doMove matches doMoveReference in " << games
+            << " games" << std::endl;
+    }
+    return errors == 0 ? 0 : 1;
+}
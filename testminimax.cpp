@@ -23,7 +23,7 @@ int main(int argc, char *argv[]) {
     board->setBoard(boardData);
 
     // Initialize player as the white player, and set testing_minimax flag.
-    Player *player = new Player(WHITE);
+    Player *player = new Player(WHITE, nullptr);
     player->testingMinimax = true;
 
 
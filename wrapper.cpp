@@ -12,8 +12,10 @@ int main(int argc, char *argv[]) {
     }
     Side side = (!strcmp(argv[1], "Black")) ? BLACK : WHITE;
 
-    // Initialize player.
-    Player *player = new Player(side);
+    // Initialize player, with the position cache shared with earlier games.
+    PositionCache *cache = new PositionCache(PositionCache::defaultPath(),
+        Player::cacheFingerprint());
+    Player *player = new Player(side, cache);
 
     // Tell java wrapper that we are done initializing.
     cout << "Init done" << endl;
@@ -106,5 +108,8 @@ int main(int argc, char *argv[]) {
         if (playersMove != nullptr) delete playersMove;
     }
 
+    // Game over; deleting the player saves its cache.
+    delete player;
+    delete cache;
     return 0;
 }